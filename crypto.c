@@ -7,6 +7,7 @@
 
 #include "pwm.h"
 #include "crypto.h"
+#include "perf.h"
 
 #include "argon2.h"
 #include "tomcrypt.h"
@@ -154,7 +155,9 @@ bool DeriveKey
     context.flags = ARGON2_DEFAULT_FLAGS;
     context.version = ARGON2_VERSION_NUMBER;
 
+    uint64_t startUs = PerfGetTimeUs();
     int ret = argon2_ctx(&context, Argon2_id);
+    PerfAddKdfTime(startUs);
 
     if (ret != ARGON2_OK)
     {
@@ -9,6 +9,7 @@
 
 #include "pwm.h"
 #include "file.h"
+#include "perf.h"
 
 
 /*--------------------------------------------------------------------------------------------------
@@ -25,12 +26,16 @@ int CreateFile
     const char *fileNamePtr             ///< [IN] Path of fle to create.
 )
 {
+    uint64_t startUs = PerfGetTimeUs();
+
     int fd;
     do
     {
         fd = creat(fileNamePtr, S_IRUSR | S_IWUSR);
     } while ( (fd == -1) && (errno == EINTR) );
 
+    PerfAddIoTime(startUs);
+
     DEBUG_IF(fd == -1, "Could not create file %s.  %m.", fileNamePtr);
 
     return fd;
@@ -51,12 +56,16 @@ int OpenFile
     const char *fileNamePtr             ///< [IN] Path of fle to create.
 )
 {
+    uint64_t startUs = PerfGetTimeUs();
+
     int fd;
     do
     {
         fd = open(fileNamePtr, O_RDONLY);
     } while ( (fd == -1) && (errno == EINTR) );
 
+    PerfAddIoTime(startUs);
+
     DEBUG_IF(fd == -1, "Could not open file %s.  %m.", fileNamePtr);
 
     return fd;
@@ -79,6 +88,7 @@ bool WriteBuf
     size_t          bufSize             ///< [IN] Size of buffer.
 )
 {
+    uint64_t startUs = PerfGetTimeUs();
     const uint8_t* currentPtr = bufPtr;
     size_t numBytes = 0;
 
@@ -93,6 +103,7 @@ bool WriteBuf
         if (c == -1)
         {
             DEBUG("Could not write to file.  %m.");
+            PerfAddIoTime(startUs);
             return false;
         }
 
@@ -101,7 +112,11 @@ bool WriteBuf
     }
 
     // Flush the write to disk.
-    if (fsync(fd) != 0)
+    PerfCountFsync();
+    int result = fsync(fd);
+    PerfAddIoTime(startUs);
+
+    if (result != 0)
     {
         DEBUG("Could not flush to disk.  %m.");
         return false;
@@ -127,6 +142,7 @@ bool ReadBuf
     size_t*         bufSizePtr          ///< [IN/OUT] Size of buffer.
 )
 {
+    uint64_t startUs = PerfGetTimeUs();
     uint8_t* currentPtr = bufPtr;
     size_t numBytes = 0;
 
@@ -141,6 +157,7 @@ bool ReadBuf
         if (c == -1)
         {
             DEBUG("Could not read to file.  %m.");
+            PerfAddIoTime(startUs);
             return false;
         }
 
@@ -154,6 +171,8 @@ bool ReadBuf
         currentPtr += c;
     }
 
+    PerfAddIoTime(startUs);
+
     *bufSizePtr = numBytes;
     return true;
 }
@@ -202,7 +221,11 @@ bool DoesFileExist
 {
     struct stat statBuf;
 
-    if (stat(pathPtr, &statBuf) == 0)
+    uint64_t startUs = PerfGetTimeUs();
+    int result = stat(pathPtr, &statBuf);
+    PerfAddIoTime(startUs);
+
+    if (result == 0)
     {
         return true;
     }
@@ -0,0 +1,644 @@
+/*
+ * Performance history utilities.
+ *
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "pwm.h"
+#include "perf.h"
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* History file layout.  The header is the file version followed by the total number of records
+* ever written.  The header is followed by NUM_PERF_RECORDS fixed sized records:
+*
+* | **totalUs** | **kdfUs** | **ioUs** | **numItems** | **numFsyncs** | **cmd** | **pad** |
+*
+* All values are little endian.  No secrets, item names or wall clock times are stored.
+*
+*-------------------------------------------------------------------------------------------------*/
+#define PERF_FILE_VERSION               2
+#define NUM_PERF_RECORDS                1024
+#define HEADER_SIZE                     5
+#define RECORD_SIZE                     20
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Minimum number of runs of a command before a trend is shown.
+*
+*-------------------------------------------------------------------------------------------------*/
+#define MIN_TREND_RUNS                  4
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Performance record type.
+*
+*-------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t totalUs;                   ///< Command time excluding user input.
+    uint32_t kdfUs;                     ///< Key derivation time.
+    uint32_t ioUs;                      ///< File system time including directory traversal.
+    uint16_t numItems;                  ///< Number of existing item files used.
+    uint16_t numFsyncs;                 ///< Number of flushes to disk.
+    uint8_t cmd;                        ///< Command.
+}
+PerfRecord_t;
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Measurements for the current command.
+*
+*-------------------------------------------------------------------------------------------------*/
+static bool IsStarted = false;
+static bool IsClockFailed = false;
+static uint8_t CurrentCmd;
+static uint64_t StartUs;
+static uint64_t PauseStartUs;
+static size_t PauseDepth;
+static uint64_t PausedUs;
+static uint64_t KdfUs;
+static uint64_t IoUs;
+static size_t NumItems;
+static size_t NumFsyncs;
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Command names indexed by PERF_CMD_*.
+*
+*-------------------------------------------------------------------------------------------------*/
+static const char *CmdNames[NUM_PERF_CMDS] =
+    {"init", "destroy", "list", "config", "get", "create", "update", "delete"};
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Records loaded from the history file in chronological order.
+*
+*-------------------------------------------------------------------------------------------------*/
+static PerfRecord_t Records[NUM_PERF_RECORDS];
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Saturate a value to 32 bits.
+*
+*-------------------------------------------------------------------------------------------------*/
+static uint32_t Clamp32
+(
+    uint64_t value                      ///< [IN] Value.
+)
+{
+    return (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Saturate a value to 16 bits.
+*
+*-------------------------------------------------------------------------------------------------*/
+static uint16_t Clamp16
+(
+    uint64_t value                      ///< [IN] Value.
+)
+{
+    return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Store a value in little endian.
+*
+*-------------------------------------------------------------------------------------------------*/
+static void PutLe
+(
+    uint8_t *bufPtr,                    ///< [OUT] Buffer.
+    uint32_t value,                     ///< [IN] Value.
+    size_t numBytes                     ///< [IN] Number of bytes to store.
+)
+{
+    size_t i = 0;
+    for (; i < numBytes; i++)
+    {
+        bufPtr[i] = (uint8_t)(value >> (8*i));
+    }
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Load a little endian value.
+*
+* @return
+*       Value.
+*
+*-------------------------------------------------------------------------------------------------*/
+static uint32_t GetLe
+(
+    const uint8_t *bufPtr,              ///< [IN] Buffer.
+    size_t numBytes                     ///< [IN] Number of bytes to load.
+)
+{
+    uint32_t value = 0;
+
+    size_t i = 0;
+    for (; i < numBytes; i++)
+    {
+        value |= (uint32_t)bufPtr[i] << (8*i);
+    }
+
+    return value;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Serialize a record.
+*
+*-------------------------------------------------------------------------------------------------*/
+static void SerializeRecord
+(
+    const PerfRecord_t *recPtr,         ///< [IN] Record.
+    uint8_t *bufPtr                     ///< [OUT] Buffer.  Assumed to be RECORD_SIZE.
+)
+{
+    memset(bufPtr, 0, RECORD_SIZE);
+    PutLe(&bufPtr[0], recPtr->totalUs, 4);
+    PutLe(&bufPtr[4], recPtr->kdfUs, 4);
+    PutLe(&bufPtr[8], recPtr->ioUs, 4);
+    PutLe(&bufPtr[12], recPtr->numItems, 2);
+    PutLe(&bufPtr[14], recPtr->numFsyncs, 2);
+    bufPtr[16] = recPtr->cmd;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Deserialize a record.
+*
+*-------------------------------------------------------------------------------------------------*/
+static void DeserializeRecord
+(
+    const uint8_t *bufPtr,              ///< [IN] Buffer.  Assumed to be RECORD_SIZE.
+    PerfRecord_t *recPtr                ///< [OUT] Record.
+)
+{
+    recPtr->totalUs = GetLe(&bufPtr[0], 4);
+    recPtr->kdfUs = GetLe(&bufPtr[4], 4);
+    recPtr->ioUs = GetLe(&bufPtr[8], 4);
+    recPtr->numItems = (uint16_t)GetLe(&bufPtr[12], 2);
+    recPtr->numFsyncs = (uint16_t)GetLe(&bufPtr[14], 2);
+    recPtr->cmd = bufPtr[16];
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Reads the total number of records written from the history file header.
+*
+* @return
+*       true if successful.
+*       false if the header is missing or has an unsupported version.
+*
+*-------------------------------------------------------------------------------------------------*/
+static bool ReadHeader
+(
+    int fd,                             ///< [IN] Open history file.
+    uint32_t *countPtr                  ///< [OUT] Total number of records written.
+)
+{
+    uint8_t header[HEADER_SIZE];
+
+    if ( (pread(fd, header, sizeof(header), 0) != sizeof(header)) ||
+         (header[0] != PERF_FILE_VERSION) )
+    {
+        return false;
+    }
+
+    *countPtr = GetLe(&header[1], 4);
+    return true;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Compare two uint32_t values in a function that can be passed to qsort.
+*
+*-------------------------------------------------------------------------------------------------*/
+static int CompareU32
+(
+    void const *first,
+    void const *second
+)
+{
+    uint32_t a = *(const uint32_t *)first;
+    uint32_t b = *(const uint32_t *)second;
+
+    return (a > b) - (a < b);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Gets a nearest-rank percentile.  The values are sorted in place.
+*
+* @return
+*       Percentile value.
+*
+*-------------------------------------------------------------------------------------------------*/
+static uint32_t Percentile
+(
+    uint32_t *valuesPtr,                ///< [IN/OUT] Values.
+    size_t numValues,                   ///< [IN] Number of values.  Must be greater than zero.
+    size_t percent                      ///< [IN] Percentile [1-100].
+)
+{
+    qsort(valuesPtr, numValues, sizeof(uint32_t), CompareU32);
+
+    size_t rank = (percent * numValues + 99) / 100;
+    return valuesPtr[(rank > 0) ? rank - 1 : 0];
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Gets the current monotonic time.  If the clock cannot be read the current measurement is discarded
+* rather than failing the command.
+*
+* @return
+*       Time in microseconds.
+*       0 if the clock could not be read.
+*
+*-------------------------------------------------------------------------------------------------*/
+uint64_t PerfGetTimeUs
+(
+    void
+)
+{
+    struct timespec ts;
+
+    // Preserve errno so callers can time a system call and still report its error.
+    int savedErrno = errno;
+
+    // The history is not essential so a clock failure only invalidates the current measurement.
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    {
+        DEBUG("Could not get time.  %m.");
+        IsClockFailed = true;
+        errno = savedErrno;
+        return 0;
+    }
+
+    errno = savedErrno;
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Starts measuring a command.  Only commands that have been started are saved to the history.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfStart
+(
+    uint8_t cmd                         ///< [IN] Command being run.  One of PERF_CMD_*.
+)
+{
+    IsStarted = true;
+    IsClockFailed = false;
+    CurrentCmd = cmd;
+    PausedUs = 0;
+    KdfUs = 0;
+    IoUs = 0;
+    NumItems = 0;
+    NumFsyncs = 0;
+    StartUs = PerfGetTimeUs();
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Discards the measurements of the current command so it is not saved to the history.  Used when
+* the user aborts a command so that no-op runs don't skew the results.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCancel
+(
+    void
+)
+{
+    IsStarted = false;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Adds the time since startUs to the key derivation time.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfAddKdfTime
+(
+    uint64_t startUs                    ///< [IN] Time the key derivation started.
+)
+{
+    KdfUs += PerfGetTimeUs() - startUs;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Adds the time since startUs to the file I/O time.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfAddIoTime
+(
+    uint64_t startUs                    ///< [IN] Time the file operation started.
+)
+{
+    IoUs += PerfGetTimeUs() - startUs;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Counts a flush to disk.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCountFsync
+(
+    void
+)
+{
+    NumFsyncs++;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Counts existing item files that the command listed, read or deleted.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCountItems
+(
+    size_t numItems                     ///< [IN] Number of items scanned.
+)
+{
+    NumItems += numItems;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Pauses the command clock while waiting on the user so that typing time is not recorded.  Must be
+* followed by a call to PerfResumeClock().  Pauses may be nested.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfPauseClock
+(
+    void
+)
+{
+    // Only the outermost pause is timed so nested pauses are not counted twice or lost.
+    if (PauseDepth++ == 0)
+    {
+        PauseStartUs = PerfGetTimeUs();
+    }
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Resumes the command clock after a call to PerfPauseClock().
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfResumeClock
+(
+    void
+)
+{
+    INTERNAL_ERR_IF(PauseDepth == 0, "Clock resumed without a pause.");
+
+    if (--PauseDepth == 0)
+    {
+        PausedUs += PerfGetTimeUs() - PauseStartUs;
+    }
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Appends the measurements of the current command to the history file.  The history file is a
+* bounded ring of fixed sized records so the oldest record is overwritten once it is full.  Failures
+* are ignored because the history is not essential to the command.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfSave
+(
+    const char *pathPtr                 ///< [IN] Path to the history file.
+)
+{
+    uint64_t endUs = PerfGetTimeUs();
+
+    if (!IsStarted || IsClockFailed)
+    {
+        return;
+    }
+
+    PerfRecord_t rec;
+    rec.totalUs = Clamp32(endUs - StartUs - PausedUs);
+    rec.kdfUs = Clamp32(KdfUs);
+    rec.ioUs = Clamp32(IoUs);
+    rec.numItems = Clamp16(NumItems);
+    rec.numFsyncs = Clamp16(NumFsyncs);
+    rec.cmd = CurrentCmd;
+
+    int fd;
+    do
+    {
+        fd = open(pathPtr, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    } while ( (fd == -1) && (errno == EINTR) );
+
+    if (fd == -1)
+    {
+        DEBUG("Could not open %s.  %m.", pathPtr);
+        return;
+    }
+
+    // Serialize with other instances updating the history.
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        DEBUG("Could not lock %s.  %m.", pathPtr);
+        close(fd);
+        return;
+    }
+
+    // Start a new history if the file is new or from an unknown version.
+    uint32_t count;
+    if (!ReadHeader(fd, &count))
+    {
+        count = 0;
+        DEBUG_IF(ftruncate(fd, 0) != 0, "Could not truncate %s.  %m.", pathPtr);
+    }
+
+    uint8_t recBuf[RECORD_SIZE];
+    SerializeRecord(&rec, recBuf);
+
+    uint8_t header[HEADER_SIZE];
+    header[0] = PERF_FILE_VERSION;
+    PutLe(&header[1], count + 1, 4);
+
+    // The history is not worth a flush to disk so the record is left for the kernel to write back.
+    off_t offset = HEADER_SIZE + (off_t)(count % NUM_PERF_RECORDS) * RECORD_SIZE;
+
+    if ( (pwrite(fd, recBuf, sizeof(recBuf), offset) != sizeof(recBuf)) ||
+         (pwrite(fd, header, sizeof(header), 0) != sizeof(header)) )
+    {
+        DEBUG("Could not write %s.  %m.", pathPtr);
+    }
+
+    close(fd);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Prints latency percentiles and trends for each command in the history file.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfReport
+(
+    const char *pathPtr                 ///< [IN] Path to the history file.
+)
+{
+    int fd;
+    do
+    {
+        fd = open(pathPtr, O_RDONLY);
+    } while ( (fd == -1) && (errno == EINTR) );
+
+    if (fd == -1)
+    {
+        HALT_IF(errno != ENOENT, "Could not open performance history.");
+        PRINT("No performance history has been recorded.");
+        return;
+    }
+
+    // Don't read while another instance is between writing a record and updating the header.
+    HALT_IF(flock(fd, LOCK_SH) != 0, "Could not lock performance history.");
+
+    // The history is never flushed to disk so it may be empty or short after a failed write or a
+    // crash.  That is not data corruption so just report what can be read.
+    uint32_t count;
+    if (!ReadHeader(fd, &count))
+    {
+        close(fd);
+        PRINT("No performance history has been recorded.");
+        return;
+    }
+
+    // Load the records oldest first.
+    size_t maxRecords = (count < NUM_PERF_RECORDS) ? count : NUM_PERF_RECORDS;
+    size_t firstSlot = (count < NUM_PERF_RECORDS) ? 0 : (count % NUM_PERF_RECORDS);
+    size_t numRecords = 0;
+
+    for (; numRecords < maxRecords; numRecords++)
+    {
+        uint8_t recBuf[RECORD_SIZE];
+        off_t offset = HEADER_SIZE +
+                       (off_t)((firstSlot + numRecords) % NUM_PERF_RECORDS) * RECORD_SIZE;
+
+        if (pread(fd, recBuf, sizeof(recBuf), offset) != sizeof(recBuf))
+        {
+            DEBUG("Performance history is truncated.");
+            break;
+        }
+
+        DeserializeRecord(recBuf, &Records[numRecords]);
+    }
+
+    close(fd);
+
+    if (numRecords == 0)
+    {
+        PRINT("No performance history has been recorded.");
+        return;
+    }
+
+    PRINT("Last %zu of %u commands.  Times are in ms and exclude waiting on user input.\n"
+          "kdf, io, fsync and items are averages per run.\n", numRecords, count);
+    PRINT("%-8s %5s %8s %8s %8s %8s %8s %8s %6s %6s %7s",
+          "command", "runs", "p50", "p90", "p99", "max", "kdf", "io", "fsync", "items", "trend");
+
+    size_t i;
+    uint8_t cmd;
+    for (cmd = 0; cmd < NUM_PERF_CMDS; cmd++)
+    {
+        if (cmd == PERF_CMD_DESTROY)
+        {
+            continue;
+        }
+
+        static uint32_t totals[NUM_PERF_RECORDS];
+        uint64_t kdfSum = 0;
+        uint64_t ioSum = 0;
+        uint64_t fsyncSum = 0;
+        uint64_t itemSum = 0;
+        size_t numRuns = 0;
+
+        for (i = 0; i < numRecords; i++)
+        {
+            if (Records[i].cmd == cmd)
+            {
+                totals[numRuns++] = Records[i].totalUs;
+                kdfSum += Records[i].kdfUs;
+                ioSum += Records[i].ioUs;
+                fsyncSum += Records[i].numFsyncs;
+                itemSum += Records[i].numItems;
+            }
+        }
+
+        if (numRuns == 0)
+        {
+            continue;
+        }
+
+        // Trend is the change in median time from the older half of the runs to the newer half.
+        char trend[16] = "-";
+        if (numRuns >= MIN_TREND_RUNS)
+        {
+            size_t half = numRuns / 2;
+            uint32_t olderMedian = Percentile(totals, half, 50);
+            uint32_t newerMedian = Percentile(&totals[numRuns - half], half, 50);
+
+            if (olderMedian > 0)
+            {
+                snprintf(trend, sizeof(trend), "%+.0f%%",
+                         100.0 * ((double)newerMedian - olderMedian) / olderMedian);
+            }
+        }
+
+        PRINT("%-8s %5zu %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %6.1f %6.1f %7s",
+              CmdNames[cmd], numRuns,
+              Percentile(totals, numRuns, 50) / 1000.0,
+              Percentile(totals, numRuns, 90) / 1000.0,
+              Percentile(totals, numRuns, 99) / 1000.0,
+              Percentile(totals, numRuns, 100) / 1000.0,
+              kdfSum / 1000.0 / numRuns,
+              ioSum / 1000.0 / numRuns,
+              (double)fsyncSum / numRuns,
+              (double)itemSum / numRuns,
+              trend);
+    }
+}
@@ -0,0 +1,158 @@
+/*
+ * Performance history utilities.
+ *
+ */
+
+#ifndef PWM_PERF_INCLUDE_GUARD
+#define PWM_PERF_INCLUDE_GUARD
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Commands that are recorded in the performance history.  These values are stored in the history
+* file so existing values must not be changed.
+*
+*-------------------------------------------------------------------------------------------------*/
+#define PERF_CMD_INIT                   0
+#define PERF_CMD_DESTROY                1   ///< Reserved.  Destroy deletes the history so it is
+                                            ///  never measured.
+#define PERF_CMD_LIST                   2
+#define PERF_CMD_CONFIG                 3
+#define PERF_CMD_GET                    4
+#define PERF_CMD_CREATE                 5
+#define PERF_CMD_UPDATE                 6
+#define PERF_CMD_DELETE                 7
+#define NUM_PERF_CMDS                   8
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Gets the current monotonic time.  If the clock cannot be read the current measurement is discarded
+* rather than failing the command.
+*
+* @return
+*       Time in microseconds.
+*       0 if the clock could not be read.
+*
+*-------------------------------------------------------------------------------------------------*/
+uint64_t PerfGetTimeUs
+(
+    void
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Starts measuring a command.  Only commands that have been started are saved to the history.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfStart
+(
+    uint8_t cmd                         ///< [IN] Command being run.  One of PERF_CMD_*.
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Discards the measurements of the current command so it is not saved to the history.  Used when
+* the user aborts a command so that no-op runs don't skew the results.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCancel
+(
+    void
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Adds the time since startUs to the key derivation time.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfAddKdfTime
+(
+    uint64_t startUs                    ///< [IN] Time the key derivation started.
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Adds the time since startUs to the file I/O time.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfAddIoTime
+(
+    uint64_t startUs                    ///< [IN] Time the file operation started.
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Counts a flush to disk.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCountFsync
+(
+    void
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Counts existing item files that the command listed, read or deleted.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfCountItems
+(
+    size_t numItems                     ///< [IN] Number of items scanned.
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Pauses the command clock while waiting on the user so that typing time is not recorded.  Must be
+* followed by a call to PerfResumeClock().  Pauses may be nested.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfPauseClock
+(
+    void
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Resumes the command clock after a call to PerfPauseClock().
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfResumeClock
+(
+    void
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Appends the measurements of the current command to the history file.  The history file is a
+* bounded ring of fixed sized records so the oldest record is overwritten once it is full.  Failures
+* are ignored because the history is not essential to the command.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfSave
+(
+    const char *pathPtr                 ///< [IN] Path to the history file.
+);
+
+
+/*--------------------------------------------------------------------------------------------------
+*
+* Prints latency percentiles and trends for each command in the history file.
+*
+*-------------------------------------------------------------------------------------------------*/
+void PerfReport
+(
+    const char *pathPtr                 ///< [IN] Path to the history file.
+);
+
+
+#endif // PWM_PERF_INCLUDE_GUARD
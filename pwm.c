@@ -16,6 +16,7 @@
 #include "crypto.h"
 #include "file.h"
 #include "password.h"
+#include "perf.h"
 #include "version.h"
 
 
@@ -35,6 +36,14 @@
 #define SYSTEM_FILE_NAME                "system"
 
 
+/*--------------------------------------------------------------------------------------------------
+*
+* Performance history file name.
+*
+*-------------------------------------------------------------------------------------------------*/
+#define PERF_FILE_NAME                  "perf"
+
+
 /*--------------------------------------------------------------------------------------------------
 *
 * Size definitions.
@@ -55,6 +64,7 @@
 static char StoragePath[PATH_MAX];
 static char SystemPath[PATH_MAX];
 static char TempPath[PATH_MAX];
+static char PerfPath[PATH_MAX];
 
 
 /*--------------------------------------------------------------------------------------------------
@@ -138,7 +148,10 @@ static void PrintHelp
         "               Updates the info for the item.\n"
         "\n"
         "       %1$s delete <itemName>\n"
-        "               Deletes the item.\n",
+        "               Deletes the item.\n"
+        "\n"
+        "       %1$s perf-report\n"
+        "               Prints latency percentiles and trends for recent commands.\n",
         Basename(utilNamePtr), VER_MAJOR, VER_MINOR, VER_PATCH);
 
     exit(EXIT_FAILURE);
@@ -264,7 +277,9 @@ static void CheckMasterPwd
             break;
         }
 
-        // Backoff timer.
+        // Backoff timer.  This is a deliberate delay so it is not counted as command time.
+        PerfPauseClock();
+
         int i = 0;
         for (i = 0; i < backOffSecs; i++)
         {
@@ -273,6 +288,8 @@ static void CheckMasterPwd
             sleep(1);
         }
 
+        PerfResumeClock();
+
         backOffSecs = 2*backOffSecs;
 
         PRINT("\nMaster password is incorrect.");
@@ -783,7 +800,10 @@ static void Init
     ReleaseSensitiveBuf(cfgDataPtr);
 
     // Create the storage location.
-    INTERNAL_ERR_IF(mkdir(StoragePath, S_IRWXU) != 0, "Could not create %s.  %m.", StoragePath);
+    uint64_t startUs = PerfGetTimeUs();
+    int result = mkdir(StoragePath, S_IRWXU);
+    PerfAddIoTime(startUs);
+    INTERNAL_ERR_IF(result != 0, "Could not create %s.  %m.", StoragePath);
 
     // Create the system file.
     int fd = CreateFile(SystemPath);
@@ -861,14 +881,26 @@ static void List
 
     // Build the list of names.
     char* pathArrayPtr[] = {StoragePath, NULL};
+    uint64_t startUs = PerfGetTimeUs();
     FTS* ftsPtr = fts_open(pathArrayPtr, FTS_PHYSICAL | FTS_NOSTAT, NULL);
+    PerfAddIoTime(startUs);
     INTERNAL_ERR_IF(ftsPtr == NULL, "Could not open dir iterator.  %m.");
 
-    FTSENT* entPtr;
-    while ( ((entPtr = fts_read(ftsPtr)) != NULL) && (numNames < MAX_NUM_ITEMS) )
+    while (numNames < MAX_NUM_ITEMS)
     {
+        // The directory traversal grows with the number of items so it is counted as I/O.
+        startUs = PerfGetTimeUs();
+        FTSENT* entPtr = fts_read(ftsPtr);
+        PerfAddIoTime(startUs);
+
+        if (entPtr == NULL)
+        {
+            break;
+        }
+
         if ( (entPtr->fts_info == FTS_NSOK) &&
-             (strcmp(entPtr->fts_path, SystemPath) != 0) )
+             (strcmp(entPtr->fts_path, SystemPath) != 0) &&
+             (strcmp(entPtr->fts_path, PerfPath) != 0) )
         {
             uint8_t nonce[NONCE_SIZE];
             uint8_t tag[TAG_SIZE];
@@ -884,7 +916,11 @@ static void List
         }
     }
 
+    startUs = PerfGetTimeUs();
     fts_close(ftsPtr);
+    PerfAddIoTime(startUs);
+
+    PerfCountItems(numNames);
 
     // Sort the list.
     qsort(nameArray, numNames, sizeof(char *), CompareStr);
@@ -964,7 +1000,10 @@ static void Config
     close(fd);
 
     // Relink the temp file.
-    INTERNAL_ERR_IF(rename(TempPath, SystemPath) != 0, "Could not save updates.  %m.");
+    uint64_t startUs = PerfGetTimeUs();
+    int result = rename(TempPath, SystemPath);
+    PerfAddIoTime(startUs);
+    INTERNAL_ERR_IF(result != 0, "Could not save updates.  %m.");
 
     PRINT("Done.");
 }
@@ -999,6 +1038,7 @@ static void GetItem
     // Check if the item exist.
     GetItemPath(itemNamePtr, masterPwdPtr, fileSalt, pathPtr);
     HALT_IF(!DoesFileExist(pathPtr), "Item doesn't exist.");
+    PerfCountItems(1);
 
     // Read item data.
     ReadItem(pathPtr, masterPwdPtr, usernamePtr, pwdPtr, otherInfoPtr);
@@ -1102,6 +1142,10 @@ static void CreateNewItem
 
         PRINT("Saved.");
     }
+    else
+    {
+        PerfCancel();
+    }
     ReleaseSensitiveBuf(pathPtr);
 }
 
@@ -1136,6 +1180,7 @@ static void UpdateItem
     // Check if the item exist.
     GetItemPath(itemNamePtr, masterPwdPtr, fileSalt, pathPtr);
     HALT_IF(!DoesFileExist(pathPtr), "Item doesn't exist.");
+    PerfCountItems(1);
 
     // Read item data.
     ReadItem(pathPtr, masterPwdPtr, usernamePtr, pwdPtr, otherInfoPtr);
@@ -1201,6 +1246,7 @@ static void UpdateItem
         ReleaseSensitiveBuf(encKeyPtr);
         ReleaseSensitiveBuf(pathPtr);
         PRINT("No changes.");
+        PerfCancel();
         return;
     }
 
@@ -1227,6 +1273,7 @@ static void UpdateItem
     if (!GetYesNo(true))
     {
         PRINT("Discarding changes.");
+        PerfCancel();
         return;
     }
 
@@ -1237,7 +1284,10 @@ static void UpdateItem
     close(fd);
 
     // Relink the temp file.
-    INTERNAL_ERR_IF(rename(TempPath, pathPtr) != 0, "Could not save updates.  %m.");
+    uint64_t startUs = PerfGetTimeUs();
+    int result = rename(TempPath, pathPtr);
+    PerfAddIoTime(startUs);
+    INTERNAL_ERR_IF(result != 0, "Could not save updates.  %m.");
     ReleaseSensitiveBuf(pathPtr);
 
     PRINT("Updates saved.");
@@ -1270,17 +1320,22 @@ static void DeleteItem
 
     GetItemPath(itemNamePtr, masterPwdPtr, fileSalt, pathPtr);
     HALT_IF(!DoesFileExist(pathPtr), "Item doesn't exist.");
+    PerfCountItems(1);
     ReleaseSensitiveBuf(masterPwdPtr);
 
     // Confirm delete.
     PRINT("Are you sure you want to delete this item [y/N]?");
     if (!GetYesNo(false))
     {
+        PerfCancel();
         return;
     }
 
     // Delete the file.
-    INTERNAL_ERR_IF(unlink(pathPtr) != 0, "Could not delete item.  %m.");
+    uint64_t startUs = PerfGetTimeUs();
+    int result = unlink(pathPtr);
+    PerfAddIoTime(startUs);
+    INTERNAL_ERR_IF(result != 0, "Could not delete item.  %m.");
     ReleaseSensitiveBuf(pathPtr);
 
     PRINT("Item deleted.");
@@ -1351,6 +1406,10 @@ int main(int argc, char* argv[])
                              "%s/temp", StoragePath) >= sizeof(TempPath),
                     "Temp path too long.");
 
+    INTERNAL_ERR_IF(snprintf(PerfPath, sizeof(PerfPath),
+                             "%s/%s", StoragePath, PERF_FILE_NAME) >= sizeof(PerfPath),
+                    "Performance history path too long.");
+
     // Process command line.
     switch (argc)
     {
@@ -1361,6 +1420,7 @@ int main(int argc, char* argv[])
             }
             else if (strcmp(argv[1], "init") == 0)
             {
+                PerfStart(PERF_CMD_INIT);
                 Init();
             }
             else if (strcmp(argv[1], "destroy") == 0)
@@ -1369,12 +1429,18 @@ int main(int argc, char* argv[])
             }
             else if (strcmp(argv[1], "list") == 0)
             {
+                PerfStart(PERF_CMD_LIST);
                 List();
             }
             else if (strcmp(argv[1], "config") == 0)
             {
+                PerfStart(PERF_CMD_CONFIG);
                 Config();
             }
+            else if (strcmp(argv[1], "perf-report") == 0)
+            {
+                PerfReport(PerfPath);
+            }
             else
             {
                 PrintHelp(argv[0]);
@@ -1387,18 +1453,22 @@ int main(int argc, char* argv[])
 
             if (strcmp(argv[1], "get") == 0)
             {
+                PerfStart(PERF_CMD_GET);
                 GetItem(itemNamePtr);
             }
             else if (strcmp(argv[1], "create") == 0)
             {
+                PerfStart(PERF_CMD_CREATE);
                 CreateNewItem(itemNamePtr);
             }
             else if (strcmp(argv[1], "update") == 0)
             {
+                PerfStart(PERF_CMD_UPDATE);
                 UpdateItem(itemNamePtr);
             }
             else if (strcmp(argv[1], "delete") == 0)
             {
+                PerfStart(PERF_CMD_DELETE);
                 DeleteItem(itemNamePtr);
             }
             else
@@ -1413,5 +1483,8 @@ int main(int argc, char* argv[])
             PrintHelp(argv[0]);
     }
 
+    // Record the command in the performance history.
+    PerfSave(PerfPath);
+
     return EXIT_SUCCESS;
 }
@@ -11,6 +11,7 @@
 #include "pwm.h"
 #include "ui.h"
 #include "password.h"
+#include "perf.h"
 
 /*--------------------------------------------------------------------------------------------------
 *
@@ -244,6 +245,9 @@ void GetLine
     size_t bufSize                      ///< [IN] Buffer size.
 )
 {
+    // Don't count the time the user takes to type.
+    PerfPauseClock();
+
     while (1)
     {
         INTERNAL_ERR_IF(fgets(bufPtr, bufSize, stdin) == NULL,
@@ -276,6 +280,8 @@ void GetLine
             while ( (c != '\n') && (c != EOF) );
         }
     }
+
+    PerfResumeClock();
 }
 
 
@@ -417,6 +423,9 @@ void SharePasswordWithClipboard
     {
         PRINT("OK hit any key when you are done with the password.");
 
+        // Don't count the time the password is held on the clipboard.
+        PerfPauseClock();
+
         ShareWithClipboard(pwdPtr);
 
         // Flush everything up to the next newline.
@@ -426,6 +435,8 @@ void SharePasswordWithClipboard
             c = getchar();
         }
         while ( (c != '\n') && (c != EOF) );
+
+        PerfResumeClock();
     }
 }
 